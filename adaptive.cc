@@ -0,0 +1,203 @@
+// Adaptive quality controller: watch per-stage timings & deadline misses,
+// step quality down under load and back up again when headroom returns
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <algorithm>
+
+#include <opencv2/core.hpp>
+
+#include "adaptive.h"
+
+#define ADAPT_WINDOW	1.0		// seconds per evaluation window
+#define ADAPT_HIGH		0.9		// load (busy/deadline) above which we degrade
+#define ADAPT_LOW		0.6		// load below which we may recover
+#define ADAPT_MISSES	0.1		// fraction of missed deadlines that forces a degrade
+#define ADAPT_CALM		3		// consecutive calm windows before recovering
+#define ADAPT_CALM_MAX	48		// backoff limit after recoveries that had to be undone
+
+static const char *names[ADAPT_NLEVELS] = {
+	"full", "half-rate", "small-model", "no-denoise", "low-res"
+};
+static const char *stages[ADAPT_NSTAGES] = {
+	"infer", "post", "mask", "render"
+};
+
+struct _adaptinfo_t {
+	pthread_mutex_t lock;
+	int level;
+	int levels;		// mask of levels that do something in this pipeline
+	double frame;	// capture frame period (s)
+	double mask;	// target mask period (s)
+	// accumulators for current window
+	double sum[ADAPT_NSTAGES];
+	int cnt[ADAPT_NSTAGES];
+	int miss[ADAPT_NSTAGES];
+	int64 start;
+	int calm;
+	// recovery prediction: per-stage load seen when we last left each level,
+	// first window per-stage load at the current level, and backoff after
+	// failed recoveries
+	double left[ADAPT_NLEVELS][ADAPT_NSTAGES];
+	double base[ADAPT_NSTAGES];
+	bool havebase;
+	int need;
+	int held;
+	bool probation;
+	int debug;
+};
+
+// mask deadline relaxes once we deliberately run inference at half rate
+static double deadline(adaptinfo_t *pad, int stage, int level) {
+	if (ADAPT_STAGE_RENDER==stage)
+		return pad->frame;
+	if (ADAPT_STAGE_MASK==stage)
+		return level>=ADAPT_HALFRATE ? 2*pad->mask : pad->mask;
+	return 0;
+}
+
+// next available level in given direction (eg: no model switch without a
+// fallback model, no denoise step for HOG)
+static int step(adaptinfo_t *pad, int dir) {
+	for (int lvl = pad->level+dir; lvl>=ADAPT_FULL && lvl<ADAPT_NLEVELS; lvl += dir)
+		if (pad->levels & ADAPT_LEVEL(lvl))
+			return lvl;
+	return pad->level;
+}
+
+static void reset(adaptinfo_t *pad) {
+	memset(pad->sum, 0, sizeof(pad->sum));
+	memset(pad->cnt, 0, sizeof(pad->cnt));
+	memset(pad->miss, 0, sizeof(pad->miss));
+	pad->start = cv::getTickCount();
+}
+
+adaptinfo_t *adapt_init(int framerate, int maskrate, int levels, int debug) {
+	if (framerate<=0 || maskrate<=0)
+		return NULL;
+	adaptinfo_t *pad = new adaptinfo_t;
+	pad->lock = PTHREAD_MUTEX_INITIALIZER;
+	pad->level = ADAPT_FULL;
+	pad->levels = levels | ADAPT_LEVEL(ADAPT_FULL);
+	pad->frame = 1.0/framerate;
+	pad->mask = 1.0/maskrate;
+	pad->calm = 0;
+	memset(pad->left, 0, sizeof(pad->left));
+	pad->havebase = false;
+	pad->need = ADAPT_CALM;
+	pad->held = 0;
+	pad->probation = false;
+	pad->debug = debug;
+	reset(pad);
+	return pad;
+}
+
+// called from both render (capture) thread and main loop
+void adapt_record(adaptinfo_t *pad, int stage, double secs) {
+	pthread_mutex_lock(&pad->lock);
+	pad->sum[stage] += secs;
+	pad->cnt[stage]++;
+	double dl = deadline(pad, stage, pad->level);
+	if (dl>0 && secs>dl)
+		pad->miss[stage]++;
+	pthread_mutex_unlock(&pad->lock);
+}
+
+int adapt_level(adaptinfo_t *pad) {
+	pthread_mutex_lock(&pad->lock);
+	int lvl = pad->level;
+	pthread_mutex_unlock(&pad->lock);
+	return lvl;
+}
+
+// evaluate window (if complete) and adjust level, returns current level
+int adapt_update(adaptinfo_t *pad) {
+	pthread_mutex_lock(&pad->lock);
+	double el = (cv::getTickCount()-pad->start)/cv::getTickFrequency();
+	if (el < ADAPT_WINDOW) {
+		int lvl = pad->level;
+		pthread_mutex_unlock(&pad->lock);
+		return lvl;
+	}
+	// worst load & miss ratio over the deadline stages, plus the load we
+	// would see one level up with current timings (only differs by deadline)
+	double avg[ADAPT_NSTAGES], sload[ADAPT_NSTAGES];
+	double load = 0, next = 0, misses = 0;
+	int up = step(pad, -1);
+	for (int s=0; s<ADAPT_NSTAGES; s++) {
+		avg[s] = pad->cnt[s] ? pad->sum[s]/pad->cnt[s] : 0;
+		sload[s] = 0;
+		double dl = deadline(pad, s, pad->level);
+		if (dl<=0 || !pad->cnt[s])
+			continue;
+		sload[s] = avg[s]/dl;
+		load = std::max(load, sload[s]);
+		next = std::max(next, avg[s]/deadline(pad, s, up));
+		misses = std::max(misses, (double)pad->miss[s]/pad->cnt[s]);
+	}
+	// timings at a cheaper level say little about the level above, so predict
+	// its cost per stage from the load we saw when we left it, scaled by how
+	// much that stage's load here has changed since we arrived (eg: competing
+	// app went away)
+	if (!pad->havebase) {
+		memcpy(pad->base, sload, sizeof(pad->base));
+		pad->havebase = true;
+	}
+	double predict = next;
+	for (int s=0; up!=pad->level && s<ADAPT_NSTAGES; s++) {
+		if (pad->left[up][s]>0 && pad->base[s]>0)
+			predict = std::max(predict, pad->left[up][s]*sload[s]/pad->base[s]);
+	}
+	int prev = pad->level;
+	if (load>ADAPT_HIGH || misses>ADAPT_MISSES) {
+		// recovery didn't stick: wait longer before trying again
+		if (pad->probation)
+			pad->need = std::min(pad->need*2, ADAPT_CALM_MAX);
+		memcpy(pad->left[pad->level], sload, sizeof(sload));
+		pad->level = step(pad, +1);
+		pad->calm = 0;
+	} else if (predict<ADAPT_LOW && 0==misses) {
+		if (++pad->calm >= pad->need) {
+			// carry the change in conditions seen here over to the stored
+			// loads of all levels above, so the next step up predicts sanely
+			for (int l=ADAPT_FULL; l<=up; l++)
+				for (int s=0; s<ADAPT_NSTAGES; s++)
+					if (pad->base[s]>0)
+						pad->left[l][s] *= sload[s]/pad->base[s];
+			pad->level = up;
+		}
+	} else {
+		pad->calm = 0;
+	}
+	if (pad->level!=prev) {
+		pad->probation = pad->level<prev;
+		pad->calm = 0;
+		pad->held = 0;
+		pad->havebase = false;
+	} else if (pad->probation && ++pad->held >= ADAPT_CALM) {
+		// recovered level held, back to normal recovery pace
+		pad->probation = false;
+		pad->need = ADAPT_CALM;
+	}
+	if (pad->level!=prev || pad->debug>1) {
+		printf("\nadapt: %s -> %s (load:%.2f predict:%.2f miss:%.2f", names[prev], names[pad->level], load, predict, misses);
+		for (int s=0; s<ADAPT_NSTAGES; s++)
+			printf(" %s:%.1fms/%d", stages[s], avg[s]*1000.0, pad->miss[s]);
+		printf(")\n");
+		fflush(stdout);
+	}
+	reset(pad);
+	int lvl = pad->level;
+	pthread_mutex_unlock(&pad->lock);
+	return lvl;
+}
+
+const char *adapt_name(int level) {
+	if (level<ADAPT_FULL || level>=ADAPT_NLEVELS)
+		return "?";
+	return names[level];
+}
+
+void adapt_stop(adaptinfo_t *pad) {
+	delete pad;
+}
@@ -0,0 +1,33 @@
+#ifndef _ADAPTIVE_H_
+#define _ADAPTIVE_H_
+
+
+// opaque type for callers
+struct _adaptinfo_t;
+typedef struct _adaptinfo_t adaptinfo_t;
+
+// timed pipeline stages
+#define ADAPT_STAGE_INFER	0	// tf_infer() (or hog_faces())
+#define ADAPT_STAGE_POST	1	// scores to mask, morphology, blur, upscale
+#define ADAPT_STAGE_MASK	2	// whole mask cycle (deadline: mask period)
+#define ADAPT_STAGE_RENDER	3	// blend, convert, write (deadline: frame period)
+#define ADAPT_NSTAGES		4
+
+// quality levels, each one includes all degradations above it
+#define ADAPT_FULL		0	// everything on
+#define ADAPT_HALFRATE	1	// halve inference duty cycle
+#define ADAPT_SMALLMODEL	2	// switch to fallback model (if provided)
+#define ADAPT_NODENOISE	3	// drop morphology steps
+#define ADAPT_LOWRES	4	// blend at half resolution
+#define ADAPT_NLEVELS	5
+#define ADAPT_LEVEL(l)	(1<<(l))	// bits for available levels mask
+#define ADAPT_ALL		((1<<ADAPT_NLEVELS)-1)
+
+adaptinfo_t *adapt_init(int framerate, int maskrate, int levels, int debug);
+void adapt_record(adaptinfo_t *pad, int stage, double secs);
+int adapt_level(adaptinfo_t *pad);
+int adapt_update(adaptinfo_t *pad);
+const char *adapt_name(int level);
+void adapt_stop(adaptinfo_t *pad);
+
+#endif // _ADAPTIVE_H_
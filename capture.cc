@@ -3,6 +3,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <pthread.h>
+#include <sys/syscall.h>
 
 #include <opencv2/videoio.hpp>
 #include <opencv2/videoio/videoio_c.h>	// for various macro values
@@ -16,6 +17,7 @@ struct _capinfo_t {
 	int64 cnt;
 	pthread_mutex_t lock;
 	pthread_t tid;
+	volatile pid_t ktid;	// kernel thread id, for affinity/scheduling
 	struct timespec last;
 	int w, h, rate;
 	bool (*callback)(cv::Mat *, void *);
@@ -26,6 +28,7 @@ struct _capinfo_t {
 static void *grab_thread(void *arg) {
 	capinfo_t *ci = (capinfo_t *)arg;
 	bool done = false;
+	ci->ktid = (pid_t)syscall(SYS_gettid);
 	// while we have a grab frame.. grab frames
 	while (!done) {
 		bool ok = ci->cap->grab();
@@ -65,6 +68,7 @@ capinfo_t *capture_init(const char *device, int *w, int *h, int *r, int debug) {
 	pcap->lock = PTHREAD_MUTEX_INITIALIZER;
 	pcap->callback = NULL;
 	pcap->cb_ctx = NULL;
+	pcap->ktid = 0;
 	// check for local device name and ensure using V4L2, set capture props,
 	// otherwise assume URL and allow OpenCV to choose the right backend,
 	// finally, always enable RGB (actually BGR24) conversion so we have sane input
@@ -112,6 +116,15 @@ int64 capture_count(capinfo_t *pcap) {
 	return pcap->cnt;
 }
 
+pid_t capture_tid(capinfo_t *pcap) {
+	// wait for grab thread to start
+	while (!pcap->ktid) {
+		struct timespec ts = { 0, 1000000 }; // 1ms
+		clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+	}
+	return pcap->ktid;
+}
+
 void capture_setcb(capinfo_t *pcap, bool (*cb)(cv::Mat *, void *), void *ctx) {
 	pthread_mutex_lock(&pcap->lock);
 	pcap->callback = cb;
@@ -22,8 +22,10 @@ limitations under the License.
 
 #include "loopback.h"
 #include "capture.h"
-#include "inference.h"
+#include "segment.h"
 #include "dlibhog.h"
+#include "adaptive.h"
+#include "topology.h"
 
 #define TFLITE_MINIMAL_CHECK(x)                              \
   if (!(x)) {                                                \
@@ -41,9 +43,6 @@ void trap(int sig) {
 	exit(1);
 }
 
-// deeplabv3 classes
-std::vector<std::string> labels = { "background", "aeroplane", "bicycle", "bird", "boat", "bottle", "bus", "car", "cat", "chair", "cow", "dining table", "dog", "horse", "motorbike", "person", "potted plant", "sheep", "sofa", "train", "tv" };
-
 typedef struct {
 	capinfo_t *pcap;
 	capinfo_t *pbkg;
@@ -54,11 +53,121 @@ typedef struct {
 	int debug;
 	bool done;
 	pthread_mutex_t lock;
+	adaptinfo_t *pad;
+	// output frame intervals (s) for jitter stats
+#define JITTER_N 256
+	int64 lastout;
+	float ivl[JITTER_N];
+	int nivl;
+	// startup timeline
+	int64 start, firstout;
 } frame_ctx_t;
 
+// p99 of output frame interval deviation from mean (s)
+float jitter_p99(frame_ctx_t *pfr) {
+	pthread_mutex_lock(&pfr->lock);
+	std::vector<float> dev(pfr->ivl, pfr->ivl + std::min(pfr->nivl, JITTER_N));
+	pthread_mutex_unlock(&pfr->lock);
+	if (dev.empty())
+		return 0;
+	float mean = 0;
+	for (float v : dev) mean += v;
+	mean /= dev.size();
+	for (float &v : dev) v = fabsf(v-mean);
+	size_t p = (dev.size()*99)/100;
+	std::nth_element(dev.begin(), dev.begin()+p, dev.end());
+	return dev[p];
+}
+
+// startup state, each slow init step runs in its own thread
+typedef struct {
+	int64 start;
+	const char *ccam, *back, *modelname, *smallname;
+	int width, height, threads, debug;
+	bool usehog;
+	topoinfo_t *pto;
+	// results
+	capinfo_t *pcap, *pbkg;
+	int capw, caph, rate;
+	cv::Mat bg;
+	bool bkgok;
+	hoginfo_t *phg;
+	segmodel_t models[2];
+	int nmodels;
+	bool modelok;
+	int64 ready;
+} init_ctx_t;
+
+void *init_capture(void *arg) {
+	init_ctx_t *pic = (init_ctx_t *)arg;
+	// open capture device stream, pass in/out expected/actual size
+	pic->capw = pic->width;
+	pic->caph = pic->height;
+	pic->pcap = capture_init(pic->ccam, &pic->capw, &pic->caph, &pic->rate, pic->debug);
+	if (pic->pcap!=NULL)
+		topo_apply(pic->pto, TOPO_CAPTURE, capture_tid(pic->pcap));
+	return NULL;
+}
+
+void *init_background(void *arg) {
+	init_ctx_t *pic = (init_ctx_t *)arg;
+	// check background file extension (yeah, I know) to spot videos..
+	pic->pbkg = NULL;
+	pic->bkgok = false;
+	int bkgw = pic->width, bkgh = pic->height, bkgr;
+	char *dot = rindex((char*)pic->back, '.');
+	if (dot!=NULL &&
+		(strcasecmp(dot, ".png")==0 ||
+		 strcasecmp(dot, ".jpg")==0 ||
+		 strcasecmp(dot, ".jpeg")==0)) {
+		// read background into raw BGR24 format, resize to output
+		pic->bg = cv::imread(pic->back);
+		if (pic->bg.empty())
+			return NULL;
+		cv::resize(pic->bg,pic->bg,cv::Size(pic->width,pic->height));
+	} else {
+		// assume video background..start capture
+		pic->pbkg = capture_init(pic->back, &bkgw, &bkgh, &bkgr, pic->debug);
+		if (NULL==pic->pbkg)
+			return NULL;
+		topo_apply(pic->pto, TOPO_BACKGROUND, capture_tid(pic->pbkg));
+		// first frame, so render has something to show
+		capture_frame(pic->pbkg, pic->bg);
+		cv::resize(pic->bg,pic->bg,cv::Size(pic->width,pic->height));
+	}
+	pic->bkgok = true;
+	return NULL;
+}
+
+void *init_model(void *arg) {
+	init_ctx_t *pic = (init_ctx_t *)arg;
+	// Are we flowing or hogging?
+	pic->phg = NULL;
+	pic->nmodels = 0;
+	pic->modelok = false;
+	if (pic->usehog) {
+		// Load HOG
+		pic->phg = hog_init(pic->debug);
+	} else {
+		// Load TF model(s), main first then optional small fallback. TFLite
+		// worker threads inherit our affinity when they are created (during
+		// init and first inference), so this thread takes the TFLite set
+		topo_apply(pic->pto, TOPO_TFLITE, 0);
+		if (!seg_load(&pic->models[pic->nmodels++], pic->modelname, pic->threads, pic->debug))
+			return NULL;
+		if (pic->smallname!=NULL &&
+			!seg_load(&pic->models[pic->nmodels++], pic->smallname, pic->threads, pic->debug))
+			return NULL;
+	}
+	pic->ready = cv::getTickCount();
+	pic->modelok = true;
+	return NULL;
+}
+
 // Process an incoming raw video frame
 bool process_frame(cv::Mat *cap, void *ctx) {
 	frame_ctx_t *pfr = (frame_ctx_t *)ctx;
+	int64 t0 = cv::getTickCount();
 	// grab next available background frame (if video)
 	if (pfr->pbkg!=NULL) {
 		capture_frame(pfr->pbkg, pfr->bg);
@@ -74,13 +183,19 @@ bool process_frame(cv::Mat *cap, void *ctx) {
 
 	// alpha blend cap and background images using mask, adapted from:
 	// https://www.learnopencv.com/alpha-blending-using-opencv-cpp-python/
-	cv::Mat out = cv::Mat::zeros(cap->size(), cap->type());
-	uint8_t *optr = (uint8_t*)out.data;
 	pthread_mutex_lock(&pfr->lock);     // (lock to protect access to mask.data)
-	uint8_t *rptr = (uint8_t*)cap->data;
-	uint8_t *bptr = (uint8_t*)pfr->bg.data;
+	// if the mask is smaller than output (adaptive low-res), blend at mask size
+	cv::Mat blcap = *cap, blbg = pfr->bg;
+	if (pfr->mask.size() != cap->size()) {
+		cv::resize(*cap,blcap,pfr->mask.size(),0,0,cv::INTER_NEAREST);
+		cv::resize(pfr->bg,blbg,pfr->mask.size(),0,0,cv::INTER_NEAREST);
+	}
+	cv::Mat out = cv::Mat::zeros(blcap.size(), blcap.type());
+	uint8_t *optr = (uint8_t*)out.data;
+	uint8_t *rptr = (uint8_t*)blcap.data;
+	uint8_t *bptr = (uint8_t*)blbg.data;
 	float   *aptr = (float*)pfr->mask.data;
-	int npix = cap->rows * cap->cols;
+	int npix = blcap.rows * blcap.cols;
 	for (int pix=0; pix<npix; ++pix) {
 		// blending weights
 		float rw=*aptr, bw=1.0-rw;
@@ -91,6 +206,8 @@ bool process_frame(cv::Mat *cap, void *ctx) {
 		++aptr;
 	}
 	pthread_mutex_unlock(&pfr->lock);
+	if (out.size() != cap->size())
+		cv::resize(out,out,cap->size());
 
 	// write frame to v4l2loopback
 	cv::Mat yuv;
@@ -102,6 +219,16 @@ bool process_frame(cv::Mat *cap, void *ctx) {
 			return false;
 		framesize -= ret;
 	}
+	int64 t1 = cv::getTickCount();
+	if (pfr->pad!=NULL)
+		adapt_record(pfr->pad, ADAPT_STAGE_RENDER, (t1-t0)/cv::getTickFrequency());
+	pthread_mutex_lock(&pfr->lock);
+	if (!pfr->firstout)
+		pfr->firstout = t1;
+	if (pfr->lastout)
+		pfr->ivl[pfr->nivl++ % JITTER_N] = (t1-pfr->lastout)/cv::getTickFrequency();
+	pfr->lastout = t1;
+	pthread_mutex_unlock(&pfr->lock);
 
 	char ti[64];
 	if (pfr->debug > 2) {
@@ -138,11 +265,17 @@ int main(int argc, char* argv[]) {
 
 	bool usehog = false;
 	const char* modelname = "deeplabv3_257_mv_gpu.tflite";
+	const char* smallname = NULL;
+	int maskrate = 0;
+	std::vector<const char *> topospecs;
+	topoinfo_t *pto = NULL;
 
 	for (int arg=1; arg<argc; arg++) {
 		if (strncmp(argv[arg], "-?", 2)==0) {
 			fprintf(stderr, "usage: deepseg [-?] [-d] [-c <capture:/dev/video1>] [-v <vcam:/dev/video0>] [-w <width:640>] [-h <height:480>]\n"
-							"[-t <tensorflow threads:2>] -m <tf model file>] [-b <background.png>] [-g (use dlib hoG, not tensorflow)]\n");
+							"[-t <tensorflow threads:2>] -m <tf model file>] [-b <background.png>] [-g (use dlib hoG, not tensorflow)]\n"
+							"[-a <adaptive quality, target mask fps>] [-M <small tf model for adaptive fallback>]\n"
+							"[-p <thread role (capture|background|infer|tflite)>:<cpus>[:fifo<prio>|nice<n>]] (repeatable)\n");
 			exit(0);
 		} else if (strncmp(argv[arg], "-d", 2)==0) {
 			++debug;
@@ -156,6 +289,12 @@ int main(int argc, char* argv[]) {
 			back = argv[++arg];
 		} else if (strncmp(argv[arg], "-m", 2)==0) {
 			modelname = argv[++arg];
+		} else if (strncmp(argv[arg], "-M", 2)==0) {
+			smallname = argv[++arg];
+		} else if (strncmp(argv[arg], "-a", 2)==0) {
+			sscanf(argv[++arg], "%d", &maskrate);
+		} else if (strncmp(argv[arg], "-p", 2)==0) {
+			topospecs.push_back(argv[++arg]);
 		} else if (strncmp(argv[arg], "-w", 2)==0) {
 			sscanf(argv[++arg], "%d", &width);
 		} else if (strncmp(argv[arg], "-h", 2)==0) {
@@ -173,6 +312,40 @@ int main(int argc, char* argv[]) {
 	printf("threads:%d\n", threads);
 	printf("model:  %s\n", modelname);
 	printf("usehog: %d\n", usehog);
+	printf("adapt:  %d\n", maskrate);
+	printf("small:  %s\n", smallname ? smallname : "(none)");
+
+	// thread topology, parsed after all args so -d applies wherever it is
+	if (!topospecs.empty()) {
+		pto = topo_init(debug);
+		TFLITE_MINIMAL_CHECK(pto!=NULL);
+		for (size_t t=0; t<topospecs.size(); t++) {
+			if (!topo_parse(pto, topospecs[t])) {
+				fprintf(stderr, "bad thread spec: %s\n", topospecs[t]);
+				exit(1);
+			}
+		}
+	}
+
+	// kick off slow init steps concurrently, so we can start streaming
+	// background frames while the model is still loading
+	init_ctx_t ictx;
+	ictx.start = cv::getTickCount();
+	ictx.ccam = ccam;
+	ictx.back = back;
+	ictx.modelname = modelname;
+	ictx.smallname = smallname;
+	ictx.width = width;
+	ictx.height = height;
+	ictx.threads = threads;
+	ictx.debug = debug;
+	ictx.usehog = usehog;
+	ictx.pto = pto;
+	pthread_t capt, bkgt, modt;
+	TFLITE_MINIMAL_CHECK(0==pthread_create(&modt, NULL, init_model, &ictx));
+	TFLITE_MINIMAL_CHECK(0==pthread_create(&capt, NULL, init_capture, &ictx));
+	TFLITE_MINIMAL_CHECK(0==pthread_create(&bkgt, NULL, init_background, &ictx));
+	topo_apply(pto, TOPO_INFER, 0);
 
 	// context data shared with callback
 	frame_ctx_t fctx;
@@ -181,80 +354,80 @@ int main(int argc, char* argv[]) {
 	fctx.debug = debug;
 	fctx.outw = width;
 	fctx.outh = height;
+	fctx.pad = NULL;
+	fctx.lastout = 0;
+	fctx.nivl = 0;
+	fctx.start = ictx.start;
+	fctx.firstout = 0;
 	// open loopback virtual camera stream, always with YUV420p output
 	fctx.lbfd = loopback_init(vcam,width,height,debug);
-	// open capture device stream, pass in/out expected/actual size
-	int capw = width, caph = height, rate;
-	fctx.pcap = capture_init(ccam, &capw, &caph, &rate, debug);
-	TFLITE_MINIMAL_CHECK(fctx.pcap!=NULL);
-	printf("stream info: %dx%d @ %dfps\n", capw, caph, rate);
-
-	// check background file extension (yeah, I know) to spot videos..
-	fctx.pbkg = NULL;
-	int bkgw = width, bkgh = height;
-	char *dot = rindex((char*)back, '.');
-	if (dot!=NULL &&
-		(strcasecmp(dot, ".png")==0 ||
-		 strcasecmp(dot, ".jpg")==0 ||
-		 strcasecmp(dot, ".jpeg")==0)) {
-		// read background into raw BGR24 format, resize to output
-		fctx.bg = cv::imread(back);
-		cv::resize(fctx.bg,fctx.bg,cv::Size(width,height));
-	} else {
-		// assume video background..start capture
-		fctx.pbkg = capture_init(back, &bkgw, &bkgh, &rate, debug);
-		TFLITE_MINIMAL_CHECK(fctx.pbkg!=NULL);
-	}
 
-	// Are we flowing or hogging?
-	hoginfo_t *phg = NULL;
-	tfinfo_t *ptf = NULL;
-	cv::Mat input;
-	cv::Mat output;
-	if (usehog) {
-		// Load HOG
-		phg = hog_init(debug);
-	} else {
-		// Load TF model
-		ptf = tf_init(modelname, threads, debug);
-
-		// wrap input and output tensor with cv::Mat
-		tfbuffer_t *tbuf = tf_get_buffer(ptf, TFINFO_BUF_IN);
-		input = cv::Mat(tbuf->h, tbuf->w, CV_32FC(tbuf->c), tbuf->data);
-		delete tbuf;
-		tbuf = tf_get_buffer(ptf, TFINFO_BUF_OUT);
-		output = cv::Mat(tbuf->h, tbuf->w, CV_32FC(tbuf->c), tbuf->data);
-		delete tbuf;
-		TFLITE_MINIMAL_CHECK( input.rows ==  input.cols);
-		TFLITE_MINIMAL_CHECK(output.rows == output.cols);
+	// wait for capture & background
+	pthread_join(capt, NULL);
+	TFLITE_MINIMAL_CHECK(ictx.pcap!=NULL);
+	printf("stream info: %dx%d @ %dfps\n", ictx.capw, ictx.caph, ictx.rate);
+	pthread_join(bkgt, NULL);
+	TFLITE_MINIMAL_CHECK(ictx.bkgok);
+	fctx.pcap = ictx.pcap;
+	fctx.pbkg = ictx.pbkg;
+	fctx.bg = ictx.bg;
+	int rate = ictx.rate;
+
+	// adaptive quality controller, if requested
+	if (maskrate>0) {
+		// HOG has no model to swap and no morphology to drop
+		int levels = ADAPT_ALL;
+		if (usehog || NULL==smallname)
+			levels &= ~ADAPT_LEVEL(ADAPT_SMALLMODEL);
+		if (usehog)
+			levels &= ~ADAPT_LEVEL(ADAPT_NODENOISE);
+		fctx.pad = adapt_init(rate, maskrate, levels, debug);
+		TFLITE_MINIMAL_CHECK(fctx.pad!=NULL);
 	}
 
-	// initialize mask and square ROI in center
+	// initialize masks (full & half-res for adaptive low-res) and square ROI in center,
+	// all-zero mask means we output background frames until the first real mask
 	cv::Rect roidim = cv::Rect((width-height)/2,0,height,height);
 	cv::Mat mask = cv::Mat::zeros(height,width,CV_32FC1);
 	cv::Mat mroi = mask(roidim);
+	cv::Rect lrodim = cv::Rect(roidim.x/2,0,height/2,height/2);
+	cv::Mat masklo = cv::Mat::zeros(height/2,width/2,CV_32FC1);
+	cv::Mat mrlo = masklo(lrodim);
 	mask.copyTo(fctx.mask);
 
-	// erosion/dilation elements
-	cv::Mat element3 = cv::getStructuringElement( cv::MORPH_ELLIPSE, cv::Size(3,3) );
-	cv::Mat element7 = cv::getStructuringElement( cv::MORPH_ELLIPSE, cv::Size(7,7) );
-	cv::Mat element11 = cv::getStructuringElement( cv::MORPH_ELLIPSE, cv::Size(11,11) );
-
-	const int cnum = labels.size();
-	const int pers = std::find(labels.begin(),labels.end(),"person") - labels.begin();
-
 	// attach input frame callback
 	capture_setcb(fctx.pcap, process_frame, &fctx);
 
+	// now wait for the model
+	pthread_join(modt, NULL);
+	TFLITE_MINIMAL_CHECK(ictx.modelok);
+	hoginfo_t *phg = ictx.phg;
+	segmodel_t *models = ictx.models;
+	int nmodels = ictx.nmodels;
+	int64 tmodel = ictx.ready;
+	// temporal filter state, at inference resolution
+	segtemporal_t tstate;
+	tstate.pm = NULL;
+
 	// stats
 	int64 es = cv::getTickCount();
 	int64 e1 = es;
 	int64 fr = 0;
+	int level = ADAPT_FULL;
 	while (!fctx.done) {
 
 		// grab last captured frame
 		cv::Mat cap;
 		capture_frame(fctx.pcap, cap);
+		int64 m0 = cv::getTickCount();
+
+		// adaptive quality settings for this cycle
+		bool lowres = level>=ADAPT_LOWRES;
+		bool denoise = level<ADAPT_NODENOISE && getenv("DEEPSEG_NODENOISE")==NULL;
+		segmodel_t *pm = &models[(level>=ADAPT_SMALLMODEL && nmodels>1) ? 1 : 0];
+		cv::Mat &cmask = lowres ? masklo : mask;
+		cv::Mat &cmroi = lowres ? mrlo : mroi;
+		int64 t0, t1;
 
 		// HOG or TF sir?
 		if (usehog) {
@@ -263,70 +436,60 @@ int main(int argc, char* argv[]) {
 				cv::resize(cap,cap,cv::Size(fctx.outw,fctx.outh));
 
 			// Run HOG to rough mask
-			TFLITE_MINIMAL_CHECK(hog_faces(phg, cap, output));
+			cv::Mat hogout;
+			t0 = cv::getTickCount();
+			TFLITE_MINIMAL_CHECK(hog_faces(phg, cap, hogout));
+			t1 = cv::getTickCount();
 
 			// smooth mask..
-			if (!output.empty() && getenv("DEEPSEG_NOBLUR")==NULL)
-				cv::blur(output,mask,cv::Size(7,7));
+			if (!hogout.empty() && getenv("DEEPSEG_NOBLUR")==NULL) {
+				cv::blur(hogout,mask,cv::Size(7,7));
+				if (lowres)
+					cv::resize(mask,masklo,masklo.size());
+			}
 		} else {
-			// map ROI
+			// map ROI, prepare input
 			cv::Mat roi = cap(roidim);
-			// convert BGR to RGB, resize ROI to input size
-			cv::Mat in_u8_rgb, in_resized;
-			cv::cvtColor(roi,in_u8_rgb,CV_BGR2RGB);
-			// TODO: can convert directly to float?
-			cv::resize(in_u8_rgb,in_resized,cv::Size(input.cols,input.rows));
-
-			// convert to float and normalize values to [-1;1]
-			in_resized.convertTo(input,CV_32FC3,1.0/128.0,-1.0);
+			seg_input(pm, roi);
 
 			// Run inference
-			TFLITE_MINIMAL_CHECK(tf_infer(ptf));
-
-			// create Mat for small mask
-			cv::Mat ofinal(output.rows,output.cols,CV_32FC1);
-			float* tmp = (float*)output.data;
-			float* out = (float*)ofinal.data;
-
-			// find class with maximum probability
-			if (strstr(modelname, "deeplab")) {
-				for (unsigned int n = 0; n < output.total(); n++) {
-					float maxval = -10000; int maxpos = 0;
-					for (int i = 0; i < cnum; i++) {
-						if (tmp[n*cnum+i] > maxval) {
-							maxval = tmp[n*cnum+i];
-							maxpos = i;
-						}
-					}
-					// set mask to 1.0 where class == person
-					out[n] = (maxpos==pers ? 1.0 : 0);
-				}
-   			} else if (strstr(modelname,"body-pix")) {
-				for (unsigned int n = 0; n < output.total(); n++) {
-					if (tmp[n] < 0.65) out[n] = 0; else out[n] = 1.0;
-				}
-			}
-
-			// denoise, close & open with small then large elements, adapted from:
-			// https://stackoverflow.com/questions/42065405/remove-noise-from-threshold-image-opencv-python
-			if (getenv("DEEPSEG_NODENOISE")==NULL) {
-				cv::morphologyEx(ofinal,ofinal,CV_MOP_CLOSE,element3);
-				cv::morphologyEx(ofinal,ofinal,CV_MOP_OPEN,element3);
-				cv::morphologyEx(ofinal,ofinal,CV_MOP_CLOSE,element7);
-				cv::morphologyEx(ofinal,ofinal,CV_MOP_OPEN,element7);
-				cv::dilate(ofinal,ofinal,element7);
-			}
-			// smooth mask edges
-			if (getenv("DEEPSEG_NOBLUR")==NULL)
-				cv::blur(ofinal,ofinal,cv::Size(7,7));
-			// scale up into full-sized mask
-			cv::resize(ofinal,mroi,cv::Size(mroi.cols,mroi.rows));
+			t0 = cv::getTickCount();
+			TFLITE_MINIMAL_CHECK(seg_infer(pm));
+			t1 = cv::getTickCount();
+
+			// scores to mask, denoise & smooth (SEG_TEMPORAL stays evaluation
+			// only until deepseg-eval shows it beating the denoise pass)
+			cv::Mat ofinal;
+			seg_process(pm, &tstate, ofinal, (denoise ? SEG_DENOISE : 0) |
+				(getenv("DEEPSEG_NOBLUR")==NULL ? SEG_BLUR : 0));
+			// scale up into full-sized (or half-sized) mask
+			cv::resize(ofinal,cmroi,cv::Size(cmroi.cols,cmroi.rows));
 		}
 		// update mask for render thread (under lock)
 		pthread_mutex_lock(&fctx.lock);
-		mask.copyTo(fctx.mask);
+		cmask.copyTo(fctx.mask);
 		pthread_mutex_unlock(&fctx.lock);
-		++fr;
+		if (0==fr++) {
+			double tf = cv::getTickFrequency();
+			pthread_mutex_lock(&fctx.lock);
+			int64 firstout = fctx.firstout;
+			pthread_mutex_unlock(&fctx.lock);
+			printf("\nstartup: first frame:%.0fms model ready:%.0fms first mask:%.0fms\n",
+				firstout ? (firstout-fctx.start)*1000.0/tf : -1.0,
+				(tmodel-fctx.start)*1000.0/tf, (cv::getTickCount()-fctx.start)*1000.0/tf);
+		}
+
+		// feed the adaptive controller, halve our duty cycle if asked to
+		if (fctx.pad!=NULL) {
+			int64 m1 = cv::getTickCount();
+			double tf = cv::getTickFrequency();
+			adapt_record(fctx.pad, ADAPT_STAGE_INFER, (t1-t0)/tf);
+			adapt_record(fctx.pad, ADAPT_STAGE_POST, (m1-t1)/tf);
+			adapt_record(fctx.pad, ADAPT_STAGE_MASK, (m1-m0)/tf);
+			if (level>=ADAPT_HALFRATE)
+				usleep((useconds_t)((m1-m0)*1000000/tf));
+			level = adapt_update(fctx.pad);
+		}
 
 		if (!debug) { printf("."); fflush(stdout); continue; }
 
@@ -336,13 +499,19 @@ int main(int argc, char* argv[]) {
 		e1 = e2;
 		int64 rcnt = capture_count(fctx.pcap);
 		int64 bcnt = fctx.pbkg!=NULL ? capture_count(fctx.pbkg) : 0;
-		printf("\relapsed:%0.3f gr=%ld gps:%3.1f br=%ld fr=%ld fps:%3.1f   ",
-			el, rcnt, rcnt/t, bcnt, fr, fr/t);
+		printf("\relapsed:%0.3f gr=%ld gps:%3.1f br=%ld fr=%ld fps:%3.1f q:%s jit99:%.1fms   ",
+			el, rcnt, rcnt/t, bcnt, fr, fr/t, adapt_name(level), jitter_p99(&fctx)*1000.0);
 		fflush(stdout);
 	}
 	capture_stop(fctx.pcap);
 	if (fctx.pbkg!=NULL)
 		capture_stop(fctx.pbkg);
+	if (fctx.pad!=NULL)
+		adapt_stop(fctx.pad);
+	if (pto!=NULL)
+		topo_stop(pto);
+	for (int m=0; m<nmodels; m++)
+		seg_stop(&models[m]);
 
 	return 0;
 }
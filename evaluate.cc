@@ -0,0 +1,215 @@
+// Offline accuracy vs. latency evaluation of models & post-processing settings
+//
+// Runs the deepseg segmentation steps (segment.cc) over a directory of frames
+// with ground truth masks:
+//   <dir>/images/<name>.{png,jpg}   input frames (processed in name order)
+//   <dir>/masks/<name>.png          ground truth, >127 = person
+// and prints one table row per model & post-processing combination. The
+// temporal configs assume frames are consecutive video frames.
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "segment.h"
+
+// post-processing combinations to evaluate per model, first is the
+// deepseg default that candidates are judged against
+static const struct {
+	const char *name;
+	int flags;
+} configs[] = {
+	{ "full",      SEG_DENOISE|SEG_BLUR },
+	{ "nodenoise", SEG_BLUR },
+	{ "noblur",    SEG_DENOISE },
+	{ "raw",       0 },
+	{ "temporal",  SEG_TEMPORAL|SEG_BLUR },
+	{ "tmp-noblur", SEG_TEMPORAL },
+};
+#define NCONFIGS (sizeof(configs)/sizeof(configs[0]))
+#define BASELINE 0
+#define CANDIDATE 4	// temporal
+
+typedef struct {
+	cv::Mat img;
+	cv::Mat gt;		// CV_8UC1, 0/1
+	std::string name;
+} sample_t;
+
+// boundary pixels of binary (0/1) mask
+static cv::Mat boundary(const cv::Mat& m) {
+	cv::Mat er;
+	cv::erode(m, er, cv::Mat());
+	return m - er;
+}
+
+// boundary F-measure with distance tolerance (as in DAVIS), both masks CV_8UC1 0/1
+static double bfscore(const cv::Mat& pred, const cv::Mat& gt) {
+	int tol = std::max(1, (int)(0.0075*sqrt((double)gt.rows*gt.rows + gt.cols*gt.cols) + 0.5));
+	cv::Mat disk = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(2*tol+1, 2*tol+1));
+	cv::Mat pb = boundary(pred), gb = boundary(gt), pd, gd;
+	cv::dilate(pb, pd, disk);
+	cv::dilate(gb, gd, disk);
+	int np = cv::countNonZero(pb), ng = cv::countNonZero(gb);
+	if (0==np && 0==ng)
+		return 1.0;
+	if (0==np || 0==ng)
+		return 0.0;
+	double prec = (double)cv::countNonZero(pb & gd) / np;
+	double rec  = (double)cv::countNonZero(gb & pd) / ng;
+	return (prec+rec)>0 ? 2*prec*rec/(prec+rec) : 0.0;
+}
+
+static double iou(const cv::Mat& pred, const cv::Mat& gt) {
+	int i = cv::countNonZero(pred & gt);
+	int u = cv::countNonZero(pred | gt);
+	return u ? (double)i/u : 1.0;
+}
+
+static double percentile(std::vector<double> v, int pc) {
+	if (v.empty())
+		return 0;
+	size_t p = std::min(v.size()-1, (v.size()*pc)/100);
+	std::nth_element(v.begin(), v.begin()+p, v.end());
+	return v[p];
+}
+
+static bool load_samples(const char *dir, std::vector<sample_t>& samples, int width, int height) {
+	std::vector<cv::String> files;
+	cv::glob(std::string(dir)+"/images/*", files, false);
+	std::sort(files.begin(), files.end());
+	for (size_t f=0; f<files.size(); f++) {
+		std::string base = files[f].substr(files[f].find_last_of('/')+1);
+		base = base.substr(0, base.find_last_of('.'));
+		sample_t s;
+		s.name = base;
+		s.img = cv::imread(files[f]);
+		cv::Mat gt = cv::imread(std::string(dir)+"/masks/"+base+".png", cv::IMREAD_GRAYSCALE);
+		if (s.img.empty() || gt.empty()) {
+			fprintf(stderr, "skipping %s (missing image or mask)\n", base.c_str());
+			continue;
+		}
+		// same as capture path: frames arrive at output size
+		if (s.img.cols != width || s.img.rows != height)
+			cv::resize(s.img, s.img, cv::Size(width,height));
+		cv::resize(gt, gt, cv::Size(width,height), 0, 0, cv::INTER_NEAREST);
+		s.gt = gt > 127;
+		s.gt /= 255;
+		samples.push_back(s);
+	}
+	return !samples.empty();
+}
+
+int main(int argc, char* argv[]) {
+	int debug  = 0;
+	int threads= 2;
+	int width  = 640;
+	int height = 480;
+	const char *dir = NULL;
+	std::vector<const char *> modelnames;
+
+	for (int arg=1; arg<argc; arg++) {
+		if (strncmp(argv[arg], "-?", 2)==0) {
+			fprintf(stderr, "usage: deepseg-eval [-?] [-d] -i <dataset dir> [-m <tf model file>]... [-w <width:640>] [-h <height:480>] [-t <tensorflow threads:2>]\n");
+			exit(0);
+		} else if (strncmp(argv[arg], "-d", 2)==0) {
+			++debug;
+		} else if (strncmp(argv[arg], "-i", 2)==0) {
+			dir = argv[++arg];
+		} else if (strncmp(argv[arg], "-m", 2)==0) {
+			modelnames.push_back(argv[++arg]);
+		} else if (strncmp(argv[arg], "-w", 2)==0) {
+			sscanf(argv[++arg], "%d", &width);
+		} else if (strncmp(argv[arg], "-h", 2)==0) {
+			sscanf(argv[++arg], "%d", &height);
+		} else if (strncmp(argv[arg], "-t", 2)==0) {
+			sscanf(argv[++arg], "%d", &threads);
+		}
+	}
+	if (NULL==dir) {
+		fprintf(stderr, "no dataset directory (-i)\n");
+		exit(1);
+	}
+	if (modelnames.empty())
+		modelnames.push_back("deeplabv3_257_mv_gpu.tflite");
+
+	std::vector<sample_t> samples;
+	if (!load_samples(dir, samples, width, height)) {
+		fprintf(stderr, "no samples in %s\n", dir);
+		exit(1);
+	}
+
+	// same square ROI in center as deepseg
+	cv::Rect roidim = cv::Rect((width-height)/2,0,height,height);
+	double tf = cv::getTickFrequency();
+
+	printf("# dataset:%s frames:%zu size:%dx%d threads:%d\n", dir, samples.size(), width, height, threads);
+	printf("%-32s %-10s %7s %7s %8s %8s %8s\n", "model", "config", "IoU", "BF", "ms/frm", "p95 ms", "post ms");
+	for (size_t m=0; m<modelnames.size(); m++) {
+		segmodel_t model;
+		if (!seg_load(&model, modelnames[m], threads, debug)) {
+			fprintf(stderr, "failed to load model: %s\n", modelnames[m]);
+			continue;
+		}
+		const char *mname = strrchr(modelnames[m], '/');
+		mname = mname ? mname+1 : modelnames[m];
+		double riou[NCONFIGS], rbf[NCONFIGS], rpost[NCONFIGS];
+		for (size_t c=0; c<NCONFIGS; c++) {
+			double siou = 0, sbf = 0, spost = 0;
+			std::vector<double> lat;
+			// frames are a sequence, temporal state runs across them
+			segtemporal_t tstate;
+			tstate.pm = NULL;
+			for (size_t s=0; s<samples.size(); s++) {
+				cv::Mat mask = cv::Mat::zeros(height,width,CV_32FC1);
+				cv::Mat mroi = mask(roidim);
+				cv::Mat roi = samples[s].img(roidim);
+
+				int64 t0 = cv::getTickCount();
+				seg_input(&model, roi);
+				if (!seg_infer(&model)) {
+					fprintf(stderr, "inference failed: %s\n", samples[s].name.c_str());
+					exit(1);
+				}
+				int64 t1 = cv::getTickCount();
+				cv::Mat ofinal;
+				seg_process(&model, &tstate, ofinal, configs[c].flags);
+				cv::resize(ofinal,mroi,cv::Size(mroi.cols,mroi.rows));
+				int64 t2 = cv::getTickCount();
+
+				// score binarized mask (blend weight >= 0.5 shows the person)
+				cv::Mat pred = mask >= 0.5;
+				pred /= 255;
+				double fi = iou(pred, samples[s].gt);
+				double fb = bfscore(pred, samples[s].gt);
+				siou += fi;
+				sbf += fb;
+				spost += (t2-t1)/tf;
+				lat.push_back((t2-t0)/tf);
+				if (debug)
+					printf("  %s %s %s iou:%.3f bf:%.3f %.1fms\n", mname, configs[c].name,
+						samples[s].name.c_str(), fi, fb, (t2-t0)*1000.0/tf);
+			}
+			double n = samples.size(), slat = 0;
+			for (double l : lat) slat += l;
+			riou[c] = siou/n;
+			rbf[c] = sbf/n;
+			rpost[c] = spost*1000.0/n;
+			printf("%-32s %-10s %7.4f %7.4f %8.2f %8.2f %8.2f\n", mname, configs[c].name,
+				riou[c], rbf[c], slat*1000.0/n, percentile(lat,95)*1000.0, rpost[c]);
+			fflush(stdout);
+		}
+		// verdict: candidate must match or beat baseline on quality & post-processing CPU
+		bool wins = riou[CANDIDATE]>=riou[BASELINE] && rbf[CANDIDATE]>=rbf[BASELINE] &&
+			rpost[CANDIDATE]<=rpost[BASELINE];
+		printf("# %s %s vs %s: dIoU:%+.4f dBF:%+.4f post:%.2fms vs %.2fms -> %s\n", mname,
+			configs[CANDIDATE].name, configs[BASELINE].name, riou[CANDIDATE]-riou[BASELINE],
+			rbf[CANDIDATE]-rbf[BASELINE], rpost[CANDIDATE], rpost[BASELINE], wins ? "WINS" : "loses");
+		seg_stop(&model);
+	}
+	return 0;
+}
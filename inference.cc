@@ -1,5 +1,10 @@
 // Wrapper for tensorflow inference processing
 //
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <tensorflow/lite/interpreter.h>
 #include <tensorflow/lite/model.h>
 #include <tensorflow/lite/kernels/register.h>
@@ -9,30 +14,53 @@
 using namespace tflite;
 
 #define ASSERT_OR_NULL(x) { if (!(x)) return NULL; }
+// as above, releasing a partially initialised info block first
+#define ASSERT_OR_STOP(p, x) { if (!(x)) { tf_stop(p); return NULL; } }
 
 struct _tfinfo_t {
 	std::unique_ptr<tflite::FlatBufferModel> model;
 	std::unique_ptr<Interpreter> interpreter;
+	void *map;
+	size_t maplen;
 	int debug;
 };
 
+// map model file read-only & prefault it, FlatBufferModel then reads weights
+// straight from the page cache without a private copy
+static void *map_model(const char *modelname, size_t *len) {
+	int fd = open(modelname, O_RDONLY);
+	if (fd<0)
+		return NULL;
+	struct stat st;
+	void *map = MAP_FAILED;
+	if (0==fstat(fd, &st) && st.st_size>0)
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE|MAP_POPULATE, fd, 0);
+	close(fd);
+	if (MAP_FAILED==map)
+		return NULL;
+	*len = st.st_size;
+	return map;
+}
+
 tfinfo_t *tf_init(const char *modelname, int threads, int debug) {
 	// Allocate info block
 	tfinfo_t *ptf = new tfinfo_t;
 	ptf->debug = debug;
 
 	// Load model
-	ptf->model = tflite::FlatBufferModel::BuildFromFile(modelname);
-	ASSERT_OR_NULL(ptf->model != nullptr);
+	ptf->map = map_model(modelname, &ptf->maplen);
+	ASSERT_OR_STOP(ptf, ptf->map != NULL);
+	ptf->model = tflite::FlatBufferModel::BuildFromBuffer((const char *)ptf->map, ptf->maplen);
+	ASSERT_OR_STOP(ptf, ptf->model != nullptr);
 
 	// Build the interpreter
 	tflite::ops::builtin::BuiltinOpResolver resolver;
 	InterpreterBuilder builder(*(ptf->model), resolver);
 	builder(&ptf->interpreter);
-	ASSERT_OR_NULL(ptf->interpreter != nullptr);
+	ASSERT_OR_STOP(ptf, ptf->interpreter != nullptr);
 
 	// Allocate tensor buffers.
-	ASSERT_OR_NULL(ptf->interpreter->AllocateTensors() == kTfLiteOk);
+	ASSERT_OR_STOP(ptf, ptf->interpreter->AllocateTensors() == kTfLiteOk);
 
 	// set interpreter params
 	ptf->interpreter->SetNumThreads(threads);
@@ -64,4 +92,10 @@ bool tf_infer(tfinfo_t *ptf) {
 }
 
 void tf_stop(tfinfo_t *ptf) {
+	// interpreter & model reference the mapping, drop them first
+	ptf->interpreter.reset();
+	ptf->model.reset();
+	if (ptf->map != NULL)
+		munmap(ptf->map, ptf->maplen);
+	delete ptf;
 }
@@ -0,0 +1,206 @@
+// Segmentation steps shared by deepseg and the evaluation tool: input
+// preparation, inference, scores to person mask and mask post-processing
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgproc/types_c.h>
+
+#include "segment.h"
+
+// deeplabv3 classes
+static std::vector<std::string> labels = { "background", "aeroplane", "bicycle", "bird", "boat", "bottle", "bus", "car", "cat", "chair", "cow", "dining table", "dog", "horse", "motorbike", "person", "potted plant", "sheep", "sofa", "train", "tv" };
+
+// wrap tensors, sanity check & warm up a freshly initialised model
+static bool seg_wrap(segmodel_t *pm) {
+	// wrap input and output tensor with cv::Mat
+	tfbuffer_t *tbuf = tf_get_buffer(pm->ptf, TFINFO_BUF_IN);
+	if (tbuf==NULL)
+		return false;
+	pm->input = cv::Mat(tbuf->h, tbuf->w, CV_32FC(tbuf->c), tbuf->data);
+	delete tbuf;
+	tbuf = tf_get_buffer(pm->ptf, TFINFO_BUF_OUT);
+	if (tbuf==NULL)
+		return false;
+	pm->output = cv::Mat(tbuf->h, tbuf->w, CV_32FC(tbuf->c), tbuf->data);
+	delete tbuf;
+	if (pm->input.rows != pm->input.cols || pm->output.rows != pm->output.cols)
+		return false;
+	if (SEG_DEEPLAB==pm->type && pm->output.channels() != (int)labels.size())
+		return false;
+
+	// warm up: first inference spins up worker threads & lazy allocations
+	pm->input = cv::Scalar::all(0);
+	return tf_infer(pm->ptf);
+}
+
+bool seg_load(segmodel_t *pm, const char *modelname, int threads, int debug) {
+	pm->name = modelname;
+	if (strstr(modelname, "deeplab"))
+		pm->type = SEG_DEEPLAB;
+	else if (strstr(modelname, "body-pix"))
+		pm->type = SEG_BODYPIX;
+	else {
+		fprintf(stderr, "unknown model type: %s\n", modelname);
+		return false;
+	}
+	pm->ptf = tf_init(modelname, threads, debug);
+	if (pm->ptf==NULL)
+		return false;
+	if (!seg_wrap(pm)) {
+		seg_stop(pm);
+		return false;
+	}
+	return true;
+}
+
+// BGR ROI to normalized RGB input tensor
+void seg_input(segmodel_t *pm, cv::Mat& roi) {
+	// convert BGR to RGB, resize ROI to input size
+	cv::Mat in_u8_rgb, in_resized;
+	cv::cvtColor(roi,in_u8_rgb,CV_BGR2RGB);
+	// TODO: can convert directly to float?
+	cv::resize(in_u8_rgb,in_resized,cv::Size(pm->input.cols,pm->input.rows));
+
+	// convert to float and normalize values to [-1;1]
+	in_resized.convertTo(pm->input,CV_32FC3,1.0/128.0,-1.0);
+}
+
+bool seg_infer(segmodel_t *pm) {
+	return tf_infer(pm->ptf);
+}
+
+// output tensor to person mask (1.0 = person) at output tensor size
+void seg_mask(segmodel_t *pm, cv::Mat& ofinal) {
+	static const int cnum = labels.size();
+	static const int pers = std::find(labels.begin(),labels.end(),"person") - labels.begin();
+
+	// create Mat for small mask
+	ofinal.create(pm->output.rows,pm->output.cols,CV_32FC1);
+	float* tmp = (float*)pm->output.data;
+	float* out = (float*)ofinal.data;
+
+	// find class with maximum probability
+	if (SEG_DEEPLAB==pm->type) {
+		for (unsigned int n = 0; n < pm->output.total(); n++) {
+			float maxval = -10000; int maxpos = 0;
+			for (int i = 0; i < cnum; i++) {
+				if (tmp[n*cnum+i] > maxval) {
+					maxval = tmp[n*cnum+i];
+					maxpos = i;
+				}
+			}
+			// set mask to 1.0 where class == person
+			out[n] = (maxpos==pers ? 1.0 : 0);
+		}
+	} else if (SEG_BODYPIX==pm->type) {
+		for (unsigned int n = 0; n < pm->output.total(); n++) {
+			if (tmp[n] < 0.65) out[n] = 0; else out[n] = 1.0;
+		}
+	}
+}
+
+void seg_postproc(cv::Mat& ofinal, int flags) {
+	// erosion/dilation elements
+	static const cv::Mat element3 = cv::getStructuringElement( cv::MORPH_ELLIPSE, cv::Size(3,3) );
+	static const cv::Mat element7 = cv::getStructuringElement( cv::MORPH_ELLIPSE, cv::Size(7,7) );
+
+	// denoise, close & open with small then large elements, adapted from:
+	// https://stackoverflow.com/questions/42065405/remove-noise-from-threshold-image-opencv-python
+	if (flags & SEG_DENOISE) {
+		cv::morphologyEx(ofinal,ofinal,CV_MOP_CLOSE,element3);
+		cv::morphologyEx(ofinal,ofinal,CV_MOP_OPEN,element3);
+		cv::morphologyEx(ofinal,ofinal,CV_MOP_CLOSE,element7);
+		cv::morphologyEx(ofinal,ofinal,CV_MOP_OPEN,element7);
+		cv::dilate(ofinal,ofinal,element7);
+	}
+	// smooth mask edges
+	if (flags & SEG_BLUR)
+		cv::blur(ofinal,ofinal,cv::Size(7,7));
+}
+
+// output tensor to soft person probability [0;1] at output tensor size
+void seg_prob(segmodel_t *pm, cv::Mat& prob) {
+	static const int cnum = labels.size();
+	static const int pers = std::find(labels.begin(),labels.end(),"person") - labels.begin();
+
+	prob.create(pm->output.rows,pm->output.cols,CV_32FC1);
+	float* tmp = (float*)pm->output.data;
+	float* out = (float*)prob.data;
+
+	if (SEG_DEEPLAB==pm->type) {
+		// logistic of person logit margin over best other class, so 0.5
+		// sits exactly where the argmax decision flips
+		for (unsigned int n = 0; n < pm->output.total(); n++) {
+			float other = -10000;
+			for (int i = 0; i < cnum; i++)
+				if (i != pers && tmp[n*cnum+i] > other)
+					other = tmp[n*cnum+i];
+			out[n] = 1.0f/(1.0f+expf(other-tmp[n*cnum+pers]));
+		}
+	} else if (SEG_BODYPIX==pm->type) {
+		// body-pix float_segments are raw logits (no sigmoid in the model),
+		// logistic around the old 0.65 logit threshold puts it at 0.5
+		for (unsigned int n = 0; n < pm->output.total(); n++)
+			out[n] = 1.0f/(1.0f+expf(0.65f-tmp[n]));
+	}
+}
+
+// temporal filter tuning: per update blend factor goes from MIN for
+// uncertain pixels (p~0.5) to MAX for confident ones (p~0 or 1), output
+// contrast sharpens the soft state back into a mostly binary mask
+#define TEMPORAL_MIN	0.2f
+#define TEMPORAL_MAX	0.8f
+#define TEMPORAL_GAIN	3.0f
+
+// fold new probabilities into running mask state, confidence weighted, and
+// produce mask. Single pass at inference resolution, prob is consumed
+void seg_temporal(segtemporal_t *pts, const segmodel_t *pm, cv::Mat& prob, cv::Mat& ofinal) {
+	cv::Mat& state = pts->state;
+	// 3x3 spatial support knocks out single pixel speckle (the old denoise job)
+	cv::blur(prob,prob,cv::Size(3,3));
+	// (re)start on first call or model change, even between same-sized
+	// outputs, the scores of one model don't carry over to another
+	if (pts->pm != pm || state.size() != prob.size() || state.type() != prob.type()) {
+		prob.copyTo(state);
+		pts->pm = pm;
+	}
+	ofinal.create(prob.size(),CV_32FC1);
+	float* sp = (float*)state.data;
+	float* pp = (float*)prob.data;
+	float* out = (float*)ofinal.data;
+	for (unsigned int n = 0; n < prob.total(); n++) {
+		float p = pp[n];
+		float c = fabsf(2.0f*p-1.0f);
+		float s = sp[n] + (TEMPORAL_MIN + (TEMPORAL_MAX-TEMPORAL_MIN)*c)*(p - sp[n]);
+		sp[n] = s;
+		s = (s-0.5f)*TEMPORAL_GAIN+0.5f;
+		out[n] = s < 0 ? 0 : (s > 1 ? 1 : s);
+	}
+}
+
+// scores to post-processed mask at output tensor size, state carries the
+// temporal filter between calls (unused without SEG_TEMPORAL)
+void seg_process(segmodel_t *pm, segtemporal_t *pts, cv::Mat& ofinal, int flags) {
+	if (flags & SEG_TEMPORAL) {
+		cv::Mat prob;
+		seg_prob(pm, prob);
+		seg_temporal(pts, pm, prob, ofinal);
+		seg_postproc(ofinal, flags & ~SEG_DENOISE);
+	} else {
+		seg_mask(pm, ofinal);
+		seg_postproc(ofinal, flags);
+	}
+}
+
+void seg_stop(segmodel_t *pm) {
+	// tensor wrappers point into interpreter memory
+	pm->input.release();
+	pm->output.release();
+	tf_stop(pm->ptf);
+	pm->ptf = NULL;
+}
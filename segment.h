@@ -0,0 +1,43 @@
+#ifndef _SEGMENT_H_
+#define _SEGMENT_H_
+
+#include <opencv2/core/mat.hpp>
+
+#include "inference.h"
+
+// supported model families (detected from file name)
+#define SEG_DEEPLAB		0
+#define SEG_BODYPIX		1
+
+// post-processing steps
+#define SEG_DENOISE		1	// close & open with small then large elements, dilate
+#define SEG_BLUR		2	// smooth mask edges
+#define SEG_TEMPORAL	4	// confidence weighted temporal filter (replaces SEG_DENOISE)
+
+// loaded TF model with its input/output tensors wrapped as cv::Mat
+typedef struct {
+	const char *name;
+	int type;
+	tfinfo_t *ptf;
+	cv::Mat input;
+	cv::Mat output;
+} segmodel_t;
+
+// temporal filter state at inference resolution, tied to the model whose
+// scores built it (a model switch restarts it)
+typedef struct {
+	cv::Mat state;
+	const segmodel_t *pm;
+} segtemporal_t;
+
+bool seg_load(segmodel_t *pm, const char *modelname, int threads, int debug);
+void seg_input(segmodel_t *pm, cv::Mat& roi);
+bool seg_infer(segmodel_t *pm);
+void seg_mask(segmodel_t *pm, cv::Mat& ofinal);
+void seg_postproc(cv::Mat& ofinal, int flags);
+void seg_prob(segmodel_t *pm, cv::Mat& prob);
+void seg_temporal(segtemporal_t *pts, const segmodel_t *pm, cv::Mat& prob, cv::Mat& ofinal);
+void seg_process(segmodel_t *pm, segtemporal_t *pts, cv::Mat& ofinal, int flags);
+void seg_stop(segmodel_t *pm);
+
+#endif // _SEGMENT_H_
@@ -0,0 +1,142 @@
+// Thread topology control: per-role CPU affinity and scheduling
+//
+// Roles are configured with specs of the form <role>:<cpus>[:<sched>], eg:
+//   capture:2:fifo10   pin capture/render thread to CPU 2, SCHED_FIFO prio 10
+//   tflite:4-7         keep TFLite workers on CPUs 4..7
+//   background:1:nice5 background video grabber on CPU 1, nice +5
+// an empty <cpus> leaves the affinity alone (eg: infer::nice-5)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "topology.h"
+
+static const char *roles[TOPO_NROLES] = {
+	"capture", "background", "infer", "tflite"
+};
+
+typedef struct {
+	bool pin;
+	cpu_set_t cpus;
+	int fifo;		// SCHED_FIFO priority (0 = leave alone)
+	int nice;
+	bool setnice;
+} topo_role_t;
+
+struct _topoinfo_t {
+	cpu_set_t orig;	// process affinity at startup
+	topo_role_t role[TOPO_NROLES];
+	int debug;
+};
+
+// parse CPU list, eg: "0,2,4-7"
+static bool parse_cpus(const char *s, cpu_set_t *set) {
+	CPU_ZERO(set);
+	while (*s) {
+		char *end;
+		long lo = strtol(s, &end, 10), hi = lo;
+		if (end==s)
+			return false;
+		if ('-'==*end) {
+			s = end+1;
+			hi = strtol(s, &end, 10);
+			if (end==s)
+				return false;
+		}
+		if (lo<0 || hi<lo || hi>=CPU_SETSIZE)
+			return false;
+		for (long c=lo; c<=hi; c++)
+			CPU_SET(c, set);
+		s = end;
+		if (','==*s)
+			++s;
+		else if (*s)
+			return false;
+	}
+	return CPU_COUNT(set)>0;
+}
+
+topoinfo_t *topo_init(int debug) {
+	topoinfo_t *pto = new topoinfo_t;
+	memset(pto->role, 0, sizeof(pto->role));
+	pto->debug = debug;
+	if (sched_getaffinity(0, sizeof(pto->orig), &pto->orig)) {
+		delete pto;
+		return NULL;
+	}
+	return pto;
+}
+
+bool topo_parse(topoinfo_t *pto, const char *spec) {
+	char buf[256];
+	strncpy(buf, spec, sizeof(buf)-1);
+	buf[sizeof(buf)-1] = 0;
+	char *cpus = strchr(buf, ':');
+	if (NULL==cpus)
+		return false;
+	*cpus++ = 0;
+	char *sched = strchr(cpus, ':');
+	if (sched!=NULL)
+		*sched++ = 0;
+	int r;
+	for (r=0; r<TOPO_NROLES; r++)
+		if (strcmp(buf, roles[r])==0)
+			break;
+	if (r>=TOPO_NROLES)
+		return false;
+	topo_role_t *pr = &pto->role[r];
+	if (*cpus) {
+		if (!parse_cpus(cpus, &pr->cpus))
+			return false;
+		pr->pin = true;
+	}
+	if (sched!=NULL) {
+		if (strncmp(sched, "fifo", 4)==0) {
+			pr->fifo = atoi(sched+4);
+			if (pr->fifo<sched_get_priority_min(SCHED_FIFO) || pr->fifo>sched_get_priority_max(SCHED_FIFO))
+				return false;
+		} else if (strncmp(sched, "nice", 4)==0) {
+			pr->nice = atoi(sched+4);
+			pr->setnice = true;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+// apply role settings to thread (0 = calling thread), unpinned roles get the
+// original process affinity back so they don't inherit another role's set.
+// Failures (eg: no CAP_SYS_NICE for SCHED_FIFO) are reported, not fatal.
+bool topo_apply(topoinfo_t *pto, int role, pid_t tid) {
+	if (NULL==pto)
+		return true;
+	topo_role_t *pr = &pto->role[role];
+	bool ok = true;
+	if (sched_setaffinity(tid, sizeof(cpu_set_t), pr->pin ? &pr->cpus : &pto->orig)) {
+		perror("topology: sched_setaffinity");
+		ok = false;
+	}
+	if (pr->fifo>0) {
+		struct sched_param sp = { pr->fifo };
+		if (sched_setscheduler(tid, SCHED_FIFO, &sp)) {
+			perror("topology: sched_setscheduler(SCHED_FIFO)");
+			ok = false;
+		}
+	}
+	if (pr->setnice && setpriority(PRIO_PROCESS, tid, pr->nice)) {
+		perror("topology: setpriority");
+		ok = false;
+	}
+	if (pto->debug)
+		printf("topology: %s (tid %d) pinned:%d cpus:%d fifo:%d nice:%d\n", roles[role], (int)tid,
+			pr->pin, CPU_COUNT(pr->pin ? &pr->cpus : &pto->orig), pr->fifo, pr->setnice ? pr->nice : 0);
+	return ok;
+}
+
+void topo_stop(topoinfo_t *pto) {
+	delete pto;
+}
@@ -0,0 +1,22 @@
+#ifndef _TOPOLOGY_H_
+#define _TOPOLOGY_H_
+
+#include <sys/types.h>
+
+// opaque type for callers
+struct _topoinfo_t;
+typedef struct _topoinfo_t topoinfo_t;
+
+// thread roles
+#define TOPO_CAPTURE	0	// camera grab + render callback thread
+#define TOPO_BACKGROUND	1	// background video grab thread
+#define TOPO_INFER		2	// main inference loop
+#define TOPO_TFLITE		3	// TFLite worker pool (inherits from creating thread)
+#define TOPO_NROLES		4
+
+topoinfo_t *topo_init(int debug);
+bool topo_parse(topoinfo_t *pto, const char *spec);
+bool topo_apply(topoinfo_t *pto, int role, pid_t tid);
+void topo_stop(topoinfo_t *pto);
+
+#endif // _TOPOLOGY_H_